@@ -0,0 +1,114 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "camera.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a camera pose at some point along the animation.
+// time is normalised, so 0 is the first frame and 1 is the last.
+class camera_keyframe {
+  public:
+    double time;
+    point3 lookfrom;
+    point3 lookat;
+    double focus_dist;
+};
+
+class camera_path {
+  public:
+    std::vector<camera_keyframe> keyframes; // assumed sorted by time
+
+    void add(double time, const point3& lookfrom, const point3& lookat, double focus_dist) {
+      keyframes.push_back(camera_keyframe{time, lookfrom, lookat, focus_dist});
+    }
+
+    // sets cam's lookfrom, lookat and focus_dist by linearly interpolating between
+    // the two keyframes either side of `time` (clamping at both ends).
+    void apply(camera& cam, double time) const {
+      if (keyframes.empty()) return;
+
+      size_t next = 0;
+      while (next < keyframes.size() && keyframes[next].time < time) next++;
+      if (next == 0 || next == keyframes.size()) {
+        const camera_keyframe& key = keyframes[next == 0 ? 0 : keyframes.size() - 1];
+        cam.lookfrom = key.lookfrom;
+        cam.lookat = key.lookat;
+        cam.focus_dist = key.focus_dist;
+        return;
+      }
+
+      const camera_keyframe& a = keyframes[next - 1];
+      const camera_keyframe& b = keyframes[next];
+      const double s = (time - a.time) / (b.time - a.time);
+      cam.lookfrom = (1 - s)*a.lookfrom + s*b.lookfrom;
+      cam.lookat = (1 - s)*a.lookat + s*b.lookat;
+      cam.focus_dist = (1 - s)*a.focus_dist + s*b.focus_dist;
+    }
+};
+
+// renders a sequence of frames along a camera_path.
+// the world is built once by the caller and reused for every frame; only the camera moves.
+// (there are no moving objects or acceleration structures yet, so there is nothing to refit between frames.)
+class animation {
+  public:
+    int frame_count = 24;
+    std::string output_prefix = "frame-"; // frames go to <output_prefix>0000.ppm, <output_prefix>0001.ppm, ...
+    camera_path path;
+
+    void render(camera& cam, const hittable& world) {
+      const auto start = std::chrono::steady_clock::now();
+
+      // two buffers so that frame N can be encoded to disk on the writer thread
+      // while frame N+1 is being traced into the other one.
+      std::vector<colour> buffers[2];
+      std::thread writer;
+      const std::atomic<bool> never_cancel(false);
+
+      for (int frame = 0; frame < frame_count; frame++) {
+        std::clog << "\rFrames remaining: " << (frame_count - frame) << " " << std::flush;
+
+        const double time = frame_count > 1 ? double(frame) / (frame_count - 1) : 0;
+        path.apply(cam, time);
+
+        std::vector<colour>& pixels = buffers[frame % 2];
+        // shares the rows out between cam.render_threads threads; seeded by frame so each frame gets its own noise
+        cam.render_frame(world, pixels, never_cancel, frame);
+
+        // the previous writer must be done before we hand it the next frame;
+        // it was using the other buffer so tracing this frame didn't have to wait for it.
+        if (writer.joinable()) writer.join();
+        writer = std::thread(write_frame, frame_filename(frame), cam.img_width, cam.image_height(), std::cref(pixels));
+      }
+      if (writer.joinable()) writer.join();
+
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::clog << "\rDone! " << frame_count << " frames in " << elapsed.count() << "s ("
+                << (frame_count * 3600.0 / elapsed.count()) << " frames/hour)\n";
+    }
+
+  private:
+    std::string frame_filename(int frame) const {
+      std::ostringstream name;
+      name << output_prefix << std::setw(4) << std::setfill('0') << frame << ".ppm";
+      return name.str();
+    }
+
+    static void write_frame(std::string filename, int img_width, int img_height, const std::vector<colour>& pixels) {
+      std::ofstream out(filename);
+      if (!out) {
+        std::cerr << "Could not open " << filename << " for writing\n";
+        return;
+      }
+      write_ppm(out, img_width, img_height, pixels);
+    }
+};
+
+#endif
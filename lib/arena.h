@@ -0,0 +1,135 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// bump allocator: hands out memory from big blocks one after the other and only
+// frees it all at once (when reset or destroyed). this keeps things allocated together
+// (e.g. all the spheres and materials of a scene) next to each other in memory,
+// and makes an allocation just a pointer bump instead of a trip to the heap.
+// NOTE: not thread safe; use one per thread (see scratch_arena below).
+class arena {
+  public:
+    explicit arena(size_t block_size = 64 * 1024) : block_size(block_size) {}
+    ~arena() {
+      for (char* block : blocks) std::free(block);
+    }
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+      char* p = align_up(next, alignment);
+      if (next == nullptr || p + bytes > end) {
+        // doesn't fit so start a new block; anything bigger than a block gets a block of its own
+        const size_t size = bytes + alignment > block_size ? bytes + alignment : block_size;
+        char* block = static_cast<char*>(std::malloc(size));
+        if (!block) throw std::bad_alloc();
+        blocks.push_back(block);
+        block_sizes.push_back(size);
+        end = block + size;
+        bytes_reserved += size;
+        p = align_up(block, alignment);
+      }
+      next = p + bytes;
+
+      allocation_count++;
+      bytes_in_use += bytes;
+      if (bytes_in_use > peak_bytes) peak_bytes = bytes_in_use;
+      return p;
+    }
+
+    template <typename T>
+    T* allocate_array(size_t n) {
+      return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // make_shared, but the object and its control block both live in the arena.
+    // the arena must outlive every shared_ptr made this way.
+    template <typename T, typename... Args>
+    shared_ptr<T> make(Args&&... args);
+
+    // forget everything allocated so far, keeping the memory around to reuse.
+    // if it took more than one block, they're swapped for a single block as big as all of
+    // them together, so doing the same allocations again doesn't need to touch the heap.
+    // nothing in here gets its destructor called, so only use it for plain data
+    // (or containers that have already been destroyed).
+    void reset() {
+      if (blocks.empty()) return;
+      if (blocks.size() > 1) {
+        for (char* block : blocks) std::free(block);
+        char* block = static_cast<char*>(std::malloc(bytes_reserved));
+        if (!block) throw std::bad_alloc();
+        blocks = {block};
+        block_sizes = {bytes_reserved};
+      }
+      next = blocks[0];
+      end = blocks[0] + block_sizes[0];
+      bytes_in_use = 0;
+    }
+
+    size_t allocations() const { return allocation_count; }
+    size_t peak_bytes_in_use() const { return peak_bytes; }
+    size_t bytes_from_heap() const { return bytes_reserved; }
+
+  private:
+    size_t block_size;
+    std::vector<char*> blocks;
+    std::vector<size_t> block_sizes;
+    char* next = nullptr; // first free byte in the current (last) block
+    char* end = nullptr; // one past the end of the current block
+
+    size_t allocation_count = 0;
+    size_t bytes_in_use = 0;
+    size_t peak_bytes = 0;
+    size_t bytes_reserved = 0;
+
+    static char* align_up(char* p, size_t alignment) {
+      const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+      return p + ((alignment - address % alignment) % alignment);
+    }
+};
+
+// lets standard containers and allocate_shared get their memory from an arena.
+// deallocate does nothing; the memory comes back when the arena is reset or destroyed.
+template <typename T>
+class arena_allocator {
+  public:
+    using value_type = T;
+
+    arena_allocator(arena& storage) : storage(&storage) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) : storage(other.storage) {}
+
+    T* allocate(size_t n) { return storage->allocate_array<T>(n); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const { return storage == other.storage; }
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const { return storage != other.storage; }
+
+  private:
+    template <typename U> friend class arena_allocator;
+    arena* storage;
+};
+
+template <typename T, typename... Args>
+shared_ptr<T> arena::make(Args&&... args) {
+  return std::allocate_shared<T>(arena_allocator<T>(*this), std::forward<Args>(args)...);
+}
+
+// per-thread arena for short-lived data, e.g. the ray queues of one batch of a scanline.
+// whoever uses it resets it when they're done with what they put in it.
+inline arena& scratch_arena() {
+  thread_local arena scratch(1024 * 1024);
+  return scratch;
+}
+
+#endif
@@ -1,8 +1,18 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include "arena.h"
 #include "hittable.h"
 #include "material.h"
+#include "ray_sort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class camera {
   public:
@@ -19,35 +29,95 @@ class camera {
     double defocus_angle = 0; // angle of the cone from a point on the plane of perfect focus to the disk at `lookfrom`. Similar to vfov in how it's measured if you just cut a cross-section through the cone (it's symmetrical so doesn't matter where you do that).
     double focus_dist = 10; // distance from `lookfrom` to plane of perfect focus
 
-    void render(const hittable_list& world) {
+    bool batch_rays = false; // trace a whole scanline's worth of rays one bounce at a time instead of one path at a time
+    bool sort_secondary_rays = true; // when batching, reorder the bounced rays by direction octant and origin before tracing them
+    int max_batch_rays = 1 << 16; // when batching, the row is traced a chunk of pixels at a time so at most this many rays are in flight
+
+    int render_threads = 1; // more than 1 renders horizontal bands in parallel, streaming them out in order as they finish
+    int band_height = 8; // scanlines per band when rendering in parallel
+
+    bool deterministic = false; // give every (pixel, sample, bounce) its own random numbers so the image is the same regardless of threads/batching
+    unsigned int seed = 0; // which set of random numbers to use when deterministic
+
+    void render(const hittable& world) {
+      render(world, std::cout);
+    }
+
+    void render(const hittable& world, std::ostream& out) {
       initialise();
 
       // image information
       const int max_colour = 255;
-      std::cout << "P3\n";
-      std::cout << img_width << " " << img_height << "\n";
-      std::cout << max_colour << "\n";
+      out << "P3\n";
+      out << img_width << " " << img_height << "\n";
+      out << max_colour << "\n";
 
       // actual image
       // BUG: switched up i and j; i is row number, so that's vertical.
-      for (int i = 0; i < img_height; i++) {
-        std::clog << "\rScanlines remaining: " << (img_height - i) << " " << std::flush;
-        for (int j = 0; j < img_width; j++) {
-          // aggregate colour of samples
-          colour pixel_colour(0, 0, 0);
-          for (int sample_index = 0; sample_index < samples_per_pixel; sample_index++) {
-            // get the random ray, and then the colour we get from that
-            const ray r = get_ray(i, j);
-            pixel_colour += ray_colour(r, max_depth, world);
+      const auto start = std::chrono::steady_clock::now();
+      trace_stats stats;
+      if (render_threads > 1) {
+        render_bands(world, out, stats);
+      } else {
+        std::vector<colour> row(img_width);
+        for (int i = 0; i < img_height; i++) {
+          std::clog << "\rScanlines remaining: " << (img_height - i) << " " << std::flush;
+          sample_row(i, world, row.data(), stats);
+          for (const colour& pixel_colour : row) {
+            write_colour(out, pixel_colour);
           }
-
-          // find the average of the colours
-          pixel_colour *= pixel_samples_scale;
-          write_colour(std::cout, pixel_colour);
         }
       }
       std::clog << "\rDone!                                    \n";
+
+      if (batch_rays) {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::clog << "Traced " << stats.rays_traced << " rays in " << elapsed.count() << "s ("
+                  << (stats.rays_traced / elapsed.count() / 1e6) << " Mrays/s), "
+                  << stats.sort_seconds << "s of that spent sorting, "
+                  << (stats.scratch_peak_bytes / 1024) << " KB peak scratch memory per batch\n";
+      }
+    }
+
+    // renders a whole frame into `pixels` (row-major, img_width * image_height())
+    // instead of writing straight to std::cout, so the caller can encode it later with write_ppm
+    // (e.g. on another thread while the next frame is being traced).
+    void render_frame(const hittable& world, std::vector<colour>& pixels) {
+      initialise();
+      pixels.resize(size_t(img_width) * img_height);
+      trace_stats stats;
+      for (int i = 0; i < img_height; i++) {
+        sample_row(i, world, &pixels[size_t(i) * img_width], stats);
+      }
+    }
+
+    // same as above but the rows are shared out between render_threads threads, and it gives up
+    // as soon as `cancel` is set (returning false, with `pixels` half done).
+    // rows are seeded from `pass_seed` and their index, so calling this again with a different pass_seed
+    // gives a fresh set of samples that can be averaged with the last one.
+    bool render_frame(const hittable& world, std::vector<colour>& pixels, const std::atomic<bool>& cancel, unsigned int pass_seed) {
+      initialise();
+      pixels.resize(size_t(img_width) * img_height);
+
+      std::atomic<int> next_row(0);
+      auto worker = [&]() {
+        trace_stats stats;
+        for (int i = next_row++; i < img_height && !cancel; i = next_row++) {
+          seed_random(pass_seed * img_height + i + 1);
+          sample_row(i, world, &pixels[size_t(i) * img_width], stats);
+        }
+      };
+
+      std::vector<std::thread> threads;
+      for (int t = 1; t < render_threads; t++) threads.emplace_back(worker);
+      worker();
+      for (std::thread& thread : threads) thread.join();
+
+      return !cancel;
     }
+
+    int image_height() const { return img_height; }
+
   private:
     int img_height; // calculated image height in pixels based on aspect_ratio and img_width
     point3 camera_centre;
@@ -59,6 +129,30 @@ class camera {
     vec3 defocus_disk_u; // defocus disk horizontal radius
     vec3 defocus_disk_v; // defocus disk vertical radius
 
+    // counters for batched tracing; each render thread keeps its own and they're added up at the end
+    struct trace_stats {
+      size_t rays_traced = 0;
+      double sort_seconds = 0;
+      size_t scratch_peak_bytes = 0;
+
+      trace_stats& operator+=(const trace_stats& other) {
+        rays_traced += other.rays_traced;
+        sort_seconds += other.sort_seconds;
+        scratch_peak_bytes = std::max(scratch_peak_bytes, other.scratch_peak_bytes);
+        return *this;
+      }
+    };
+
+    // one ray in flight when batching; `throughput` is the product of all the attenuations so far
+    struct queued_ray {
+      ray r;
+      colour throughput;
+      int pixel; // column of the pixel this ray's colour goes to
+      int sample_index; // which of that pixel's samples it is
+      uint64_t key; // filled in by sort_rays_by_coherence
+    };
+    using ray_queue = std::vector<queued_ray, arena_allocator<queued_ray>>;
+
     void initialise() {
       // setup the image
       img_height = std::max(int(img_width/aspect_ratio), 1);
@@ -102,7 +196,191 @@ class camera {
       pixel_samples_scale = 1.0 / samples_per_pixel;
     }
 
-    colour ray_colour(const ray& r, int depth, const hittable& world) const {
+    // renders the image in bands of band_height scanlines on render_threads threads,
+    // writing each band to `out` as soon as it and every band above it are done.
+    // at most 2 * render_threads bands are held in memory at once; a thread that gets
+    // too far ahead of the writer waits, so memory use doesn't depend on image size.
+    void render_bands(const hittable& world, std::ostream& out, trace_stats& stats) const {
+      const int band_count = (img_height + band_height - 1) / band_height;
+      const int slot_count = 2 * render_threads;
+
+      // band b goes in slot b % slot_count; it's only handed out once band b - slot_count
+      // has been written, so a slot is never in use by two bands at once.
+      std::vector<std::vector<colour>> slots(slot_count);
+      std::vector<char> slot_ready(slot_count, false);
+      int next_band = 0; // next band to hand out to a thread
+      int bands_written = 0;
+      std::mutex lock;
+      std::condition_variable changed;
+
+      auto worker = [&]() {
+        trace_stats thread_stats;
+        while (true) {
+          int band;
+          {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&] { return next_band >= band_count || next_band < bands_written + slot_count; });
+            if (next_band >= band_count) break;
+            band = next_band++;
+          }
+
+          // each band gets its own random stream so the image doesn't depend on
+          // which thread happened to pick it up.
+          seed_random(band + 1);
+
+          std::vector<colour>& pixels = slots[band % slot_count];
+          const int first_row = band * band_height;
+          const int rows = std::min(band_height, img_height - first_row);
+          pixels.resize(size_t(rows) * img_width);
+          for (int row = 0; row < rows; row++) {
+            sample_row(first_row + row, world, &pixels[size_t(row) * img_width], thread_stats);
+          }
+
+          {
+            std::lock_guard<std::mutex> guard(lock);
+            slot_ready[band % slot_count] = true;
+          }
+          changed.notify_all();
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        stats += thread_stats;
+      };
+
+      std::vector<std::thread> threads;
+      for (int t = 0; t < render_threads; t++) threads.emplace_back(worker);
+
+      // this thread is the writer: bands go out strictly in order
+      for (int band = 0; band < band_count; band++) {
+        std::clog << "\rBands remaining: " << (band_count - band) << " " << std::flush;
+        {
+          std::unique_lock<std::mutex> guard(lock);
+          changed.wait(guard, [&] { return bool(slot_ready[band % slot_count]); });
+        }
+        // the slot is ours until we mark it free again, so no need to hold the lock while writing
+        for (const colour& pixel_colour : slots[band % slot_count]) {
+          write_colour(out, pixel_colour);
+        }
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          slot_ready[band % slot_count] = false;
+          bands_written = band + 1;
+        }
+        changed.notify_all();
+      }
+
+      for (std::thread& thread : threads) thread.join();
+    }
+
+    // fills row[0..img_width) with the final colours of scanline i
+    void sample_row(int i, const hittable& world, colour* row, trace_stats& stats) const {
+      if (!batch_rays) {
+        for (int j = 0; j < img_width; j++) {
+          row[j] = sample_pixel(i, j, world);
+        }
+        return;
+      }
+
+      // breadth-first version of ray_colour: every sample of a chunk of pixels in the row
+      // goes out together, then everything that bounced goes out together, and so on.
+      // same result as the recursive version, since a path's colour is just
+      // (product of attenuations) * (background colour it finally escapes to).
+      // the queues live in this thread's scratch arena, which is thrown away after each chunk.
+      // they are reserved up front for the most rays they'll ever hold so they never reallocate,
+      // and chunks are capped at max_batch_rays so that doesn't grow with img_width * samples_per_pixel.
+      arena& scratch = scratch_arena();
+      const int chunk_pixels = std::max(1, max_batch_rays / samples_per_pixel);
+      for (int first = 0; first < img_width; first += chunk_pixels) {
+        trace_pixels(i, first, std::min(first + chunk_pixels, img_width), world, row, scratch, stats);
+        stats.scratch_peak_bytes = std::max(stats.scratch_peak_bytes, scratch.peak_bytes_in_use());
+        scratch.reset();
+      }
+    }
+
+    // traces pixels [first, last) of scanline i, breadth first
+    void trace_pixels(int i, int first, int last, const hittable& world, colour* row, arena& scratch, trace_stats& stats) const {
+      ray_queue queue(scratch), next(scratch);
+      queue.reserve(size_t(last - first) * samples_per_pixel);
+      next.reserve(queue.capacity());
+      for (int j = first; j < last; j++) {
+        for (int sample_index = 0; sample_index < samples_per_pixel; sample_index++) {
+          begin_sample_random(i, j, sample_index);
+          queue.push_back(queued_ray{get_ray(i, j), colour(1, 1, 1), j, sample_index, 0});
+        }
+      }
+
+      // each sample's colour is kept separately and only summed up at the end, in sample order,
+      // so the floating point adds happen in the same order as in sample_pixel.
+      colour* sample_colours = scratch.allocate_array<colour>(queue.size());
+      for (size_t index = 0; index < queue.size(); index++) new (&sample_colours[index]) colour(0, 0, 0);
+
+      for (int depth = max_depth; depth > 0 && !queue.empty(); depth--) {
+        stats.rays_traced += queue.size();
+        next.clear();
+        for (const queued_ray& item : queue) {
+          hit_record rec;
+          if (!world.hit(item.r, interval(0.001, infinity), rec)) {
+            sample_colours[size_t(item.pixel - first) * samples_per_pixel + item.sample_index] = item.throughput * background(item.r);
+            continue;
+          }
+          ray scattered;
+          colour attenuation;
+          begin_sample_random(i, item.pixel, item.sample_index);
+          set_bounce_random(max_depth - depth + 1);
+          if (rec.mat->scatter(item.r, rec, attenuation, scattered)) {
+            next.push_back(queued_ray{scattered, item.throughput * attenuation, item.pixel, item.sample_index, 0});
+          }
+          // absorbed rays just drop out of the queue (contribute black)
+        }
+
+        // the bounced rays go off in all directions; sort them so consecutive hit()
+        // calls look at the same part of the scene. (with a flat hittable_list every hit()
+        // still touches every object, so this only really pays off with an acceleration structure.)
+        if (sort_secondary_rays) {
+          const auto sort_start = std::chrono::steady_clock::now();
+          sort_rays_by_coherence(next);
+          stats.sort_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - sort_start).count();
+        }
+        queue.swap(next);
+      }
+      // anything still in the queue ran out of bounces, so contributes black
+      end_counter_random();
+
+      for (int j = first; j < last; j++) {
+        colour pixel_colour(0, 0, 0);
+        for (int sample_index = 0; sample_index < samples_per_pixel; sample_index++) {
+          pixel_colour += sample_colours[size_t(j - first) * samples_per_pixel + sample_index];
+        }
+        row[j] = pixel_colour * pixel_samples_scale;
+      }
+    }
+
+    void begin_sample_random(int i, int j, int sample_index) const {
+      if (deterministic) begin_counter_random(seed, uint64_t(i) * img_width + j, sample_index);
+    }
+
+    void set_bounce_random(int bounce) const {
+      if (deterministic) set_counter_random_bounce(bounce);
+    }
+
+    colour sample_pixel(int i, int j, const hittable& world) const {
+      // aggregate colour of samples
+      colour pixel_colour(0, 0, 0);
+      for (int sample_index = 0; sample_index < samples_per_pixel; sample_index++) {
+        // get the random ray, and then the colour we get from that
+        begin_sample_random(i, j, sample_index);
+        const ray r = get_ray(i, j);
+        pixel_colour += ray_colour(r, max_depth, world, colour(1, 1, 1));
+      }
+      end_counter_random();
+
+      // find the average of the colours
+      return pixel_colour * pixel_samples_scale;
+    }
+
+    // `throughput` is the product of the attenuations on the way here. multiplying it in on the way
+    // down (rather than on the way back up) gives the same rounding as the batched version.
+    colour ray_colour(const ray& r, int depth, const hittable& world, const colour& throughput) const {
       // If we've reached the bounce limit,
       // no more light is gathered, thus return black.
       if (depth <= 0) {
@@ -113,8 +391,9 @@ class camera {
       if (world.hit(r, interval(0.001, infinity), rec)) {
         ray scattered;
         colour attenuation;
+        set_bounce_random(max_depth - depth + 1);
         if (rec.mat->scatter(r, rec, attenuation, scattered)) {
-          return attenuation * ray_colour(scattered, depth-1, world);
+          return ray_colour(scattered, depth-1, world, throughput * attenuation);
         }
         // MISTAKE: forgot to return no colour (black) for being absorbed.
         return colour(0, 0, 0);
@@ -124,6 +403,10 @@ class camera {
       }
 
       // we don't have a hit so draw the background
+      return throughput * background(r);
+    }
+
+    colour background(const ray& r) const {
       const vec3 unit_direction = unit_vector(r.direction());
       // at this point, unit_direction has -1 <= y <= 1
       // since can be pointing up or down
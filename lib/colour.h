@@ -6,6 +6,8 @@
 #include "interval.h"
 #include "vec3.h"
 
+#include <vector>
+
 using colour = vec3;
 
 inline double linear_to_gamma(double linear_component) {
@@ -35,4 +37,15 @@ void write_colour(std::ostream& out, const colour& pixel_colour) {
     out << rbyte << ' ' << gbyte << ' ' << bbyte << '\n';
 }
 
+// writes a whole row-major buffer of pixel colours as a PPM image
+void write_ppm(std::ostream& out, int img_width, int img_height, const std::vector<colour>& pixels) {
+    const int max_colour = 255;
+    out << "P3\n";
+    out << img_width << " " << img_height << "\n";
+    out << max_colour << "\n";
+    for (const colour& pixel_colour : pixels) {
+        write_colour(out, pixel_colour);
+    }
+}
+
 #endif
\ No newline at end of file
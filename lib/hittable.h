@@ -3,9 +3,11 @@
 #define HITTABLE_H
 
 class material;
+class hittable;
 
 class hit_record {
   public:
+    const hittable* object = nullptr; // the (leaf) object that was hit; set by intersect, used to finalise
     point3 p;
     vec3 normal;
     shared_ptr<material> mat;
@@ -27,7 +29,29 @@ class hittable {
   public:
     virtual ~hittable() = default;
 
-    virtual bool hit(const ray& r, interval ray_t_interval, hit_record& rec) const = 0;
+    // closest hit with everything in rec filled in.
+    // done in two steps: find the closest t first, then only work out the point, normal and
+    // material for that one, rather than for every object that gets hit along the way.
+    virtual bool hit(const ray& r, interval ray_t_interval, hit_record& rec) const {
+      if (!intersect(r, ray_t_interval, rec)) return false;
+      rec.object->finalise(r, rec);
+      return true;
+    }
+
+    // finds the closest hit but only sets rec.t and rec.object
+    virtual bool intersect(const ray& r, interval ray_t_interval, hit_record& rec) const = 0;
+
+    // fills in the rest of rec (p, normal, front_face, mat) for a hit found by intersect.
+    // only ever called on the leaf object intersect put in rec.object, so lists and the like
+    // that never put themselves there can leave it empty.
+    virtual void finalise(const ray& r, hit_record& rec) const = 0;
+
+    // is there anything at all in the way? doesn't care which hit is closest, so it can stop
+    // at the first one (e.g. for shadow rays).
+    virtual bool occluded(const ray& r, interval ray_t_interval) const {
+      hit_record rec;
+      return intersect(r, ray_t_interval, rec);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -19,26 +19,36 @@ class hittable_list : public hittable {
       objects.push_back(object);
     }
 
-    bool hit(const ray& r, interval ray_t_interval, hit_record& rec) const override {
+    bool intersect(const ray& r, interval ray_t_interval, hit_record& rec) const override {
       // more efficient solution: just store closest_t instead of the entire hit_record.
+      // and only look for hits closer than the closest so far, so objects behind it are rejected straight away.
       hit_record curr_rec;
-      double closest_so_far = infinity;
+      double closest_so_far = ray_t_interval.max;
       bool has_hit = false;
 
-      for (shared_ptr<hittable> object : objects) {
+      // by reference so we don't touch the (atomic) reference count for every object on every ray
+      for (const shared_ptr<hittable>& object : objects) {
         // it's a pointer so use ->
-        if (!object->hit(r, ray_t_interval, curr_rec)) continue;
+        if (!object->intersect(r, interval(ray_t_interval.min, closest_so_far), curr_rec)) continue;
         has_hit = true;
-        if (curr_rec.t < closest_so_far) {
-          // we got a closer object so replace
-          // BLUNDER: forgot to set rec here
-          closest_so_far = curr_rec.t;
-          rec = curr_rec;
-        }
+        closest_so_far = curr_rec.t;
+        // BLUNDER: forgot to set rec here
+        rec.t = curr_rec.t;
+        rec.object = curr_rec.object;
       }
 
       return has_hit;
     }
+
+    // never ends up in rec.object (intersect passes on the object that was actually hit)
+    void finalise(const ray& r, hit_record& rec) const override {}
+
+    bool occluded(const ray& r, interval ray_t_interval) const override {
+      for (const shared_ptr<hittable>& object : objects) {
+        if (object->occluded(r, ray_t_interval)) return true;
+      }
+      return false;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "camera.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// interactive preview: keeps the world loaded and re-renders it at low quality every time
+// a camera parameter changes, instead of editing main and recompiling.
+//
+// commands come in one per line on `in`:
+//   vfov <degrees>
+//   lookfrom <x> <y> <z>
+//   lookat <x> <y> <z>
+//   defocus_angle <degrees>
+//   focus_dist <distance>
+//   quit
+// every change throws away whatever is being rendered and starts again. frames come out on
+// `out` as PPM images, one after every pass of 1 sample per pixel, each the average of all
+// the passes so far, so the picture gets less noisy the longer it's left alone.
+// after each frame a line like "frame 3 (3 spp) 212.5 ms after update" goes to std::clog,
+// which is what a headless client reads to measure time to first image.
+class preview {
+  public:
+    int preview_width = 320; // image width used while previewing
+    int preview_depth = 8; // max_depth used while previewing
+    int max_passes = 64; // stop refining after this many samples per pixel
+
+    void run(camera& cam, const hittable& world, std::istream& in, std::ostream& out) {
+      cam.img_width = preview_width;
+      cam.max_depth = preview_depth;
+      cam.samples_per_pixel = 1;
+      cam.deterministic = false; // every pass needs different samples to average together
+
+      start(cam, world, out, std::chrono::steady_clock::now());
+
+      std::string line;
+      while (std::getline(in, line)) {
+        // timed from here so the time to first frame includes cancelling the last render
+        const auto requested = std::chrono::steady_clock::now();
+        std::istringstream command(line);
+        std::string name;
+        if (!(command >> name)) continue;
+        if (name == "quit") {
+          stop();
+          return;
+        }
+
+        // parse into a copy so a bad command doesn't cancel the current render
+        camera updated = cam;
+        bool ok = false;
+        if (name == "vfov") ok = bool(command >> updated.vfov);
+        else if (name == "lookfrom") ok = read_point(command, updated.lookfrom);
+        else if (name == "lookat") ok = read_point(command, updated.lookat);
+        else if (name == "defocus_angle") ok = bool(command >> updated.defocus_angle);
+        else if (name == "focus_dist") ok = bool(command >> updated.focus_dist);
+
+        if (!ok) {
+          std::cerr << "Couldn't understand \"" << line << "\"\n";
+          continue;
+        }
+
+        stop();
+        cam = updated;
+        start(cam, world, out, requested);
+      }
+
+      // end of input: let the last render finish refining
+      if (renderer.joinable()) renderer.join();
+    }
+
+  private:
+    std::thread renderer;
+    std::atomic<bool> cancel{false};
+
+    static bool read_point(std::istream& in, point3& p) {
+      double x, y, z;
+      if (!(in >> x >> y >> z)) return false;
+      p = point3(x, y, z);
+      return true;
+    }
+
+    void stop() {
+      cancel = true;
+      if (renderer.joinable()) renderer.join();
+      cancel = false;
+    }
+
+    void start(const camera& cam, const hittable& world, std::ostream& out, std::chrono::steady_clock::time_point requested) {
+      renderer = std::thread([this, preview_cam = cam, &world, &out, requested]() mutable {
+        std::vector<colour> pass, sum;
+        for (int pass_index = 0; pass_index < max_passes; pass_index++) {
+          if (!preview_cam.render_frame(world, pass, cancel, pass_index)) return;
+
+          sum.resize(pass.size());
+          for (size_t index = 0; index < pass.size(); index++) sum[index] += pass[index];
+
+          std::vector<colour> average(sum);
+          for (colour& pixel_colour : average) pixel_colour /= pass_index + 1;
+          write_ppm(out, preview_cam.img_width, preview_cam.image_height(), average);
+          out << std::flush;
+
+          const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - requested;
+          std::clog << "frame " << (pass_index + 1) << " (" << (pass_index + 1) << " spp) "
+                    << elapsed.count() << " ms after update\n";
+        }
+      });
+    }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef RAY_SORT_H
+#define RAY_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+
+// spreads the lower 10 bits of x out so there are two zero bits between each one,
+// ready to be interleaved with two other coordinates into a morton code.
+// adapted from the usual "bit twiddling" version.
+inline uint32_t expand_bits(uint32_t x) {
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8))  & 0x0300f00f;
+    x = (x | (x << 4))  & 0x030c30c3;
+    x = (x | (x << 2))  & 0x09249249;
+    return x;
+}
+
+// 30-bit morton (z-order) code of a point already quantised to 10 bits per axis.
+// points close together in space end up with codes close together, so sorting by it
+// keeps neighbouring origins next to each other.
+inline uint32_t morton_code(uint32_t x, uint32_t y, uint32_t z) {
+    return (expand_bits(x) << 2) | (expand_bits(y) << 1) | expand_bits(z);
+}
+
+// which of the 8 octants the direction points into (one bit per axis sign)
+inline uint32_t direction_octant(const vec3& direction) {
+    return (direction.x() < 0 ? 4u : 0u) | (direction.y() < 0 ? 2u : 0u) | (direction.z() < 0 ? 1u : 0u);
+}
+
+// sorts `rays` (anything with a ray `r` and a uint64_t `key` member) so that rays going
+// in the same direction octant from nearby origins are traced one after the other.
+// the sort key is the octant in the top bits, then the morton code of the origin
+// quantised within the bounds of all the origins in the batch.
+// sorts in place so it doesn't need any extra memory.
+template <typename Container>
+void sort_rays_by_coherence(Container& rays) {
+    if (rays.size() < 2) return;
+
+    point3 lo( infinity,  infinity,  infinity);
+    point3 hi(-infinity, -infinity, -infinity);
+    for (const auto& item : rays) {
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = std::fmin(lo[axis], item.r.origin()[axis]);
+            hi[axis] = std::fmax(hi[axis], item.r.origin()[axis]);
+        }
+    }
+
+    const double cells = 1023; // 10 bits per axis
+    for (auto& item : rays) {
+        uint32_t cell[3];
+        for (int axis = 0; axis < 3; axis++) {
+            const double extent = hi[axis] - lo[axis];
+            const double s = extent > 0 ? (item.r.origin()[axis] - lo[axis]) / extent : 0;
+            cell[axis] = uint32_t(s * cells);
+        }
+        item.key = (uint64_t(direction_octant(item.r.direction())) << 30) | morton_code(cell[0], cell[1], cell[2]);
+    }
+    std::sort(rays.begin(), rays.end(), [](const auto& a, const auto& b) { return a.key < b.key; });
+}
+
+#endif
@@ -4,6 +4,7 @@
 #define RTWEEKEND_H
 
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <limits>
 #include <memory>
@@ -29,10 +30,68 @@ inline double degrees_to_radians(double degrees) {
 // MISTAKE: we have a *static* distribution and generator,
 // thus we can't just pass in the min and max as arguments
 // rather must make separate function.
+// (now thread_local rather than static so render threads don't fight over one generator.)
+inline std::mt19937& random_generator() {
+    thread_local std::mt19937 generator; // this is a good random number generator
+    return generator;
+}
+inline void seed_random(unsigned int seed) {
+    random_generator().seed(seed);
+}
+
+// counter-based random numbers, for renders that come out the same however they're scheduled.
+// rather than everything drawing from one long stream (where the numbers a sample gets depend
+// on how many were used before it), each (pixel, sample) gets a key, and the n-th number
+// drawn at a given bounce is just a hash of (key, bounce, n). while a sample is active on
+// this thread random_double comes from here instead of the generator above.
+class counter_random_state {
+  public:
+    bool active = false;
+    uint64_t key = 0;
+    uint64_t bounce = 0;
+    uint64_t dimension = 0; // how many numbers this bounce has used so far
+};
+
+inline counter_random_state& counter_random() {
+    thread_local counter_random_state state;
+    return state;
+}
+
+// splitmix64's finaliser; scrambles the bits well enough that neighbouring counters give unrelated numbers
+inline uint64_t mix_bits(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline void begin_counter_random(uint64_t seed, uint64_t pixel, uint64_t sample) {
+    counter_random_state& state = counter_random();
+    state.active = true;
+    state.key = mix_bits(mix_bits(mix_bits(seed) ^ pixel) ^ sample);
+    state.bounce = 0;
+    state.dimension = 0;
+}
+
+inline void set_counter_random_bounce(uint64_t bounce) {
+    counter_random().bounce = bounce;
+    counter_random().dimension = 0;
+}
+
+inline void end_counter_random() {
+    counter_random().active = false;
+}
+
 inline double random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator; // this is a good random number generator
-    return distribution(generator);
+    counter_random_state& state = counter_random();
+    if (state.active) {
+        const uint64_t bits = mix_bits(state.key ^ mix_bits((state.bounce << 32) | state.dimension++));
+        return (bits >> 11) * (1.0 / 9007199254740992.0); // top 53 bits into [0, 1)
+    }
+    thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(random_generator());
 }
 // MISTAKE: first *scale up* to (max-min) width; we're not normalising here so NOT division
 // then we shift it to min.
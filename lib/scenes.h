@@ -0,0 +1,78 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include "arena.h"
+#include "hittable_list.h"
+#include "material.h"
+#include "sphere.h"
+
+// everything is allocated out of `storage` so the whole scene sits together in memory;
+// storage has to outlive the returned list.
+hittable_list final_scene(arena& storage) {
+  hittable_list world;
+  
+  auto material_ground = storage.make<lambertian>(colour(0.7, 0.7, 0.7));
+  world.add(storage.make<sphere>(point3(0,-1000,0), 1000, material_ground));
+
+  // this for loop and the three spheres are taken from the website; some parameters modified though.
+  for (int a = -11; a < 11; a++) {
+    for (int b = -11; b < 11; b++) {
+      auto choose_mat = random_double();
+      point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
+
+      if ((center - point3(4, 0.2, 0)).length() > 0.9) {
+        shared_ptr<material> sphere_material;
+
+        if (choose_mat < 0.8) {
+          // diffuse
+          auto albedo = colour::random() * colour::random();
+          sphere_material = storage.make<lambertian>(albedo);
+          world.add(storage.make<sphere>(center, 0.2, sphere_material));
+        } else if (choose_mat < 0.95) {
+          // metal
+          auto albedo = colour::random(0.5, 1);
+          auto fuzz = random_double(0, 0.5);
+          sphere_material = storage.make<metal>(albedo, fuzz);
+          world.add(storage.make<sphere>(center, 0.2, sphere_material));
+        } else {
+          // glass
+          sphere_material = storage.make<dialectric>(1.5);
+          world.add(storage.make<sphere>(center, 0.2, sphere_material));
+        }
+      }
+    }
+  }
+
+  auto material1 = storage.make<dialectric>(1.5);
+  world.add(storage.make<sphere>(point3(0, 1, 0), 1.0, material1));
+
+  auto material2 = storage.make<lambertian>(colour(0.2, 0.4, 0.8));
+  world.add(storage.make<sphere>(point3(-4, 1, 0), 1.0, material2));
+
+  auto material3 = storage.make<metal>(colour(0.5, 0.6, 0.7), 0.0);
+  world.add(storage.make<sphere>(point3(4, 1, 0), 1.0, material3));
+
+  return world;
+}
+
+// the three spheres from the book's chapter on dielectrics (glass sphere with an air bubble
+// inside, between a diffuse and a metal one). small, so it's quick to render as a reference.
+hittable_list three_spheres_scene(arena& storage) {
+  hittable_list world;
+
+  auto material_ground = storage.make<lambertian>(colour(0.8, 0.8, 0.0));
+  auto material_centre = storage.make<lambertian>(colour(0.1, 0.2, 0.5));
+  auto material_left = storage.make<dialectric>(1.5);
+  auto material_bubble = storage.make<dialectric>(1.0 / 1.5);
+  auto material_right = storage.make<metal>(colour(0.8, 0.6, 0.2), 1.0);
+
+  world.add(storage.make<sphere>(point3( 0.0, -100.5, -1.0), 100.0, material_ground));
+  world.add(storage.make<sphere>(point3( 0.0,    0.0, -1.2),   0.5, material_centre));
+  world.add(storage.make<sphere>(point3(-1.0,    0.0, -1.0),   0.5, material_left));
+  world.add(storage.make<sphere>(point3(-1.0,    0.0, -1.0),   0.4, material_bubble));
+  world.add(storage.make<sphere>(point3( 1.0,    0.0, -1.0),   0.5, material_right));
+
+  return world;
+}
+
+#endif
@@ -8,7 +8,7 @@ class sphere : public hittable {
     sphere(const point3& centre, double radius, shared_ptr<material> mat) : centre{centre}, radius{std::fmax(0, radius)}, mat{mat} {
       // must initialise the material mat here.
     }
-    bool hit(const ray& r, interval ray_t_interval, hit_record& rec) const override {
+    bool intersect(const ray& r, interval ray_t_interval, hit_record& rec) const override {
       const vec3 cq = centre - r.origin();
       const double a = r.direction().length_squared();
       const double h = dot(r.direction(), cq);
@@ -30,15 +30,20 @@ class sphere : public hittable {
         }
       }
 
-      // now we should have a valid root and we populate the hit_record
+      // now we should have a valid root; the rest of the hit_record is left to finalise
+      // in case something closer turns up.
+      rec.t = root;
+      rec.object = this;
+
+      return true;
+    }
+
+    void finalise(const ray& r, hit_record& rec) const override {
       // note we can make the normal a unit vector without using the formula since we know its length is radius based on the geometry of the sphere.
-      rec.p = r.at(root);
+      rec.p = r.at(rec.t);
       vec3 outward_normal = (rec.p - centre) / radius;
       rec.set_face_normal(r, outward_normal);
-      rec.t = root;
       rec.mat = mat;
-
-      return true;
     }
   private:
     point3 centre;
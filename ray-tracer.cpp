@@ -6,51 +6,74 @@
 #include "./lib/sphere.h"
 #include "./lib/material.h"
 #include "./lib/camera.h"
+#include "./lib/animation.h"
+#include "./lib/arena.h"
+#include "./lib/preview.h"
+#include "./lib/scenes.h"
 
-int main() {
-  hittable_list world;
-  
-  auto material_ground = make_shared<lambertian>(colour(0.7, 0.7, 0.7));
-  world.add(make_shared<sphere>(point3(0,-1000,0), 1000, material_ground));
-
-  // this for loop and the three spheres are taken from the website; some parameters modified though.
-  for (int a = -11; a < 11; a++) {
-    for (int b = -11; b < 11; b++) {
-      auto choose_mat = random_double();
-      point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
-
-      if ((center - point3(4, 0.2, 0)).length() > 0.9) {
-        shared_ptr<material> sphere_material;
-
-        if (choose_mat < 0.8) {
-          // diffuse
-          auto albedo = colour::random() * colour::random();
-          sphere_material = make_shared<lambertian>(albedo);
-          world.add(make_shared<sphere>(center, 0.2, sphere_material));
-        } else if (choose_mat < 0.95) {
-          // metal
-          auto albedo = colour::random(0.5, 1);
-          auto fuzz = random_double(0, 0.5);
-          sphere_material = make_shared<metal>(albedo, fuzz);
-          world.add(make_shared<sphere>(center, 0.2, sphere_material));
-        } else {
-          // glass
-          sphere_material = make_shared<dialectric>(1.5);
-          world.add(make_shared<sphere>(center, 0.2, sphere_material));
-        }
-      }
-    }
-  }
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <vector>
 
-  auto material1 = make_shared<dialectric>(1.5);
-  world.add(make_shared<sphere>(point3(0, 1, 0), 1.0, material1));
+// times closest-hit vs. occlusion queries on random rays through the scene.
+// "eager" is what hittable_list::hit used to do: fully fill in the hit_record for
+// every object that's hit, even if something closer turns up later.
+void benchmark_hits(const hittable_list& world, int ray_count) {
+  seed_random(1);
+  std::vector<ray> rays;
+  rays.reserve(ray_count);
+  for (int index = 0; index < ray_count; index++) {
+    // from somewhere above the spheres, pointing anywhere (mostly at the ground and spheres)
+    const point3 origin(random_double(-11, 11), random_double(0.1, 3), random_double(-11, 11));
+    rays.push_back(ray(origin, random_unit_vector()));
+  }
 
-  auto material2 = make_shared<lambertian>(colour(0.2, 0.4, 0.8));
-  world.add(make_shared<sphere>(point3(-4, 1, 0), 1.0, material2));
+  auto time = [&](const char* name, auto&& query) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t hits = 0;
+    for (const ray& r : rays) hits += query(r);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::clog << name << ": " << (ray_count / elapsed.count() / 1e6) << " Mrays/s (" << hits << " hits)\n";
+  };
 
-  auto material3 = make_shared<metal>(colour(0.5, 0.6, 0.7), 0.0);
-  world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
+  time("eager closest hit", [&](const ray& r) {
+    hit_record rec, curr_rec;
+    double closest_so_far = infinity;
+    bool has_hit = false;
+    for (const shared_ptr<hittable>& object : world.objects) {
+      if (!object->hit(r, interval(0.001, infinity), curr_rec)) continue;
+      has_hit = true;
+      if (curr_rec.t < closest_so_far) {
+        closest_so_far = curr_rec.t;
+        rec = curr_rec;
+      }
+    }
+    return has_hit;
+  });
+  time("deferred closest hit", [&](const ray& r) {
+    hit_record rec;
+    return world.hit(r, interval(0.001, infinity), rec);
+  });
+  time("occluded", [&](const ray& r) {
+    return world.occluded(r, interval(0.001, infinity));
+  });
+}
 
+// usage:
+//   ./ray-tracer > img.ppm                single frame to stdout
+//   ./ray-tracer --animate [frames]       batch of frames along a camera path, written to frame-XXXX.ppm
+//   ./ray-tracer --preview                read camera changes from stdin and stream low quality frames to stdout (see lib/preview.h)
+//   ./ray-tracer --bench-hits [rays]      compare closest-hit and occlusion query speed on the scene
+// options (before the mode):
+//   --batched                             trace a scanline at a time, bounce by bounce, sorting the bounced rays
+//   --batched-unsorted                    same but without sorting, to compare against
+//   --threads N                           render bands in parallel on N threads, streaming them to stdout in order
+//   --band-height N                       scanlines per band (default 8)
+//   --deterministic [seed]                same image bit for bit whatever the threads/batching (not for --preview)
+//   --scene final|three-spheres           which scene to render (default final)
+//   --width N, --spp N, --depth N         override image width, samples per pixel and max depth
+int main(int argc, char* argv[]) {
   camera cam;
   cam.aspect_ratio = 16.0/9.0;
   cam.img_width = 1920;
@@ -65,5 +88,77 @@ int main() {
   cam.defocus_angle = 0.6;
   cam.focus_dist = 12;
 
+  std::string scene = "final";
+  int arg = 1;
+  for (; arg < argc; arg++) {
+    const std::string option = argv[arg];
+    if (option == "--scene" && arg + 1 < argc) {
+      scene = argv[++arg];
+      if (scene == "three-spheres") {
+        cam.vfov = 90;
+        cam.lookfrom = point3(0, 0, 0);
+        cam.lookat = point3(0, 0, -1);
+        cam.defocus_angle = 0;
+        cam.focus_dist = 1;
+      } else if (scene != "final") {
+        std::cerr << "Unknown scene " << scene << "\n";
+        return 1;
+      }
+    } else if (option == "--width" && arg + 1 < argc) {
+      cam.img_width = std::stoi(argv[++arg]);
+    } else if (option == "--spp" && arg + 1 < argc) {
+      cam.samples_per_pixel = std::stoi(argv[++arg]);
+    } else if (option == "--depth" && arg + 1 < argc) {
+      cam.max_depth = std::stoi(argv[++arg]);
+    } else if (option == "--batched") {
+      cam.batch_rays = true;
+    } else if (option == "--batched-unsorted") {
+      cam.batch_rays = true;
+      cam.sort_secondary_rays = false;
+    } else if (option == "--threads" && arg + 1 < argc) {
+      cam.render_threads = std::stoi(argv[++arg]);
+    } else if (option == "--deterministic") {
+      cam.deterministic = true;
+      if (arg + 1 < argc && std::isdigit(argv[arg + 1][0])) cam.seed = std::stoul(argv[++arg]);
+    } else if (option == "--band-height" && arg + 1 < argc) {
+      cam.band_height = std::max(1, std::stoi(argv[++arg]));
+    } else {
+      break;
+    }
+  }
+
+  // built once and reused for every frame in batch mode
+  arena scene_storage;
+  const hittable_list world = scene == "three-spheres" ? three_spheres_scene(scene_storage) : final_scene(scene_storage);
+  std::clog << "Scene: " << scene_storage.allocations() << " allocations, "
+            << (scene_storage.peak_bytes_in_use() / 1024) << " KB in use, "
+            << (scene_storage.bytes_from_heap() / 1024) << " KB taken from the heap\n";
+
+  if (arg < argc && std::string(argv[arg]) == "--animate") {
+    animation anim;
+    if (arg + 1 < argc) anim.frame_count = std::stoi(argv[arg + 1]);
+
+    // orbit a quarter turn around the centre sphere, pulling focus as we go
+    anim.path.add(0.0, point3(13, 3, -5), point3(0, 0, 0), 12);
+    anim.path.add(0.5, point3(10, 3, 8), point3(0, 0.5, 0), 11);
+    anim.path.add(1.0, point3(-3, 2, 13), point3(0, 1, 0), 13);
+
+    anim.render(cam, world);
+    return 0;
+  }
+
+  if (arg < argc && std::string(argv[arg]) == "--bench-hits") {
+    benchmark_hits(world, arg + 1 < argc ? std::stoi(argv[arg + 1]) : 200000);
+    return 0;
+  }
+
+  if (arg < argc && std::string(argv[arg]) == "--preview") {
+    // interactive so use every core unless told otherwise
+    if (cam.render_threads == 1) cam.render_threads = std::max(1u, std::thread::hardware_concurrency());
+    preview viewer;
+    viewer.run(cam, world, std::cin, std::cout);
+    return 0;
+  }
+
   cam.render(world);
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#!/bin/sh
+# golden-image test: renders the reference scenes with --deterministic using every
+# ray-tracer binary given (e.g. built at -O0 and -O2) and every variant below, and
+# compares each image byte for byte against tests/golden/<scene>.ppm.
+# exits non-zero if anything differs.
+#
+#   ./tests/golden.sh <ray-tracer binary>...            check
+#   ./tests/golden.sh --update <ray-tracer binary>      regenerate the references (only if the change is meant to alter the images!)
+
+dir=$(dirname "$0")/golden
+out=${TMPDIR:-/tmp}/golden-$$.ppm
+trap 'rm -f "$out"' EXIT
+
+scenes="final three-spheres"
+scene_args() {
+  case $1 in
+    final) echo "--scene final --width 160 --spp 4 --depth 10" ;;
+    three-spheres) echo "--scene three-spheres --width 160 --spp 8 --depth 10" ;;
+  esac
+}
+
+if [ "$1" = "--update" ]; then
+  for scene in $scenes; do
+    "$2" --deterministic $(scene_args $scene) > "$dir/$scene.ppm" 2>/dev/null || exit 1
+    echo "updated $dir/$scene.ppm"
+  done
+  exit 0
+fi
+
+failures=0
+for binary in "$@"; do
+  for scene in $scenes; do
+    # one variant per line; the empty line is the plain single-threaded render
+    while read -r variant; do
+      "$binary" --deterministic $variant $(scene_args $scene) > "$out" 2>/dev/null
+      if cmp -s "$out" "$dir/$scene.ppm"; then
+        echo "ok   $binary $scene $variant"
+      else
+        echo "FAIL $binary $scene $variant"
+        failures=$((failures + 1))
+      fi
+    done <<VARIANTS
+
+--threads 1
+--threads 3
+--threads 4
+--threads 3 --band-height 1
+--threads 4 --band-height 5
+--batched
+--batched-unsorted
+--batched --threads 3 --band-height 13
+VARIANTS
+  done
+done
+
+if [ $failures -ne 0 ]; then
+  echo "FAILED ($failures mismatches)"
+  exit 1
+fi
+echo "passed"
@@ -0,0 +1,58 @@
+// checks that camera::render with render_threads > 1 (bands streamed out in order)
+// gives exactly the same image as camera::render_frame (the whole frame in one buffer),
+// for a few thread counts and band heights, batched and not.
+// everything is rendered with deterministic on, so the images should match byte for byte.
+#include "../lib/rtweekend.h"
+#include "../lib/camera.h"
+#include "../lib/scenes.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main() {
+  arena scene_storage;
+  const hittable_list world = final_scene(scene_storage);
+
+  camera cam;
+  cam.aspect_ratio = 16.0/9.0;
+  cam.img_width = 96;
+  cam.samples_per_pixel = 4;
+  cam.max_depth = 10;
+  cam.vfov = 20;
+  cam.lookfrom = point3(13, 3, -5);
+  cam.lookat = point3(0, 0, 0);
+  cam.defocus_angle = 0.6;
+  cam.focus_dist = 12;
+  cam.deterministic = true;
+
+  // the reference: full-buffer render on one thread
+  std::vector<colour> pixels;
+  cam.render_frame(world, pixels);
+  std::ostringstream expected;
+  write_ppm(expected, cam.img_width, cam.image_height(), pixels);
+
+  int failures = 0;
+  const int thread_counts[] = {2, 3, 4};
+  const int band_heights[] = {1, 5, 8, 1000};
+  for (bool batched : {false, true}) {
+    for (int threads : thread_counts) {
+      for (int band_height : band_heights) {
+        cam.batch_rays = batched;
+        cam.render_threads = threads;
+        cam.band_height = band_height;
+
+        std::ostringstream streamed;
+        cam.render(world, streamed);
+
+        const bool same = streamed.str() == expected.str();
+        if (!same) failures++;
+        std::cout << (same ? "ok   " : "FAIL ") << "threads " << threads << ", band height " << band_height
+                  << (batched ? ", batched" : "") << "\n";
+      }
+    }
+  }
+
+  std::cout << (failures ? "FAILED" : "passed") << "\n";
+  return failures ? 1 : 0;
+}